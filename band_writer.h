@@ -0,0 +1,97 @@
+#ifndef BAND_WRITER_H
+#define BAND_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Escritor diferido de bandas de imagen. Los hilos de render entregan bandas
+// terminadas en cualquier orden; un hilo escritor las vuelca a `out` en orden.
+// Como mucho `max_pending` bandas esperan en memoria: si un hilo va demasiado
+// adelantado respecto a la escritura, submit() lo bloquea. Si una escritura falla,
+// las bandas siguientes se descartan y failed() pasa a true.
+class band_writer {
+public:
+    band_writer(std::ostream& out, int max_pending)
+        : out(out), max_pending(max_pending < 1 ? 1 : max_pending),
+          writer([this] { write_loop(); }) {
+    }
+
+    ~band_writer() {
+        finish();
+    }
+
+    band_writer(const band_writer&) = delete;
+    band_writer& operator=(const band_writer&) = delete;
+
+    // Entrega la banda `index` ya formateada.
+    void submit(int index, std::string data) {
+        std::unique_lock<std::mutex> lock(mutex);
+        // La banda que toca escribir siempre se acepta, asi nunca hay bloqueo mutuo.
+        space_available.wait(lock, [&] { return index < next_to_write + max_pending; });
+        pending.emplace(index, std::move(data));
+        band_ready.notify_one();
+    }
+
+    // True si alguna escritura en `out` ha fallado.
+    bool failed() const {
+        return write_failed.load(std::memory_order_relaxed);
+    }
+
+    // Espera a que el numero de bandas entregado se escriba y detiene el escritor.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done)
+                return;
+            done = true;
+        }
+        band_ready.notify_one();
+        writer.join();
+        out.flush();
+    }
+
+private:
+    std::ostream& out;
+    int max_pending;
+    int next_to_write = 0;
+    bool done = false;
+    std::atomic<bool> write_failed{ false };
+    std::map<int, std::string> pending;
+    std::mutex mutex;
+    std::condition_variable band_ready;
+    std::condition_variable space_available;
+    std::thread writer;
+
+    void write_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            band_ready.wait(lock, [&] { return done || pending.count(next_to_write) > 0; });
+            auto it = pending.find(next_to_write);
+            if (it == pending.end())
+                return;  // done y no queda nada consecutivo por escribir.
+
+            std::string data = std::move(it->second);
+            pending.erase(it);
+
+            // Se escribe sin el candado para solapar disco y calculo.
+            lock.unlock();
+            if (!failed()) {
+                out.write(data.data(), std::streamsize(data.size()));
+                if (!out)
+                    write_failed.store(true, std::memory_order_relaxed);
+            }
+            lock.lock();
+
+            next_to_write++;
+            space_available.notify_all();
+        }
+    }
+};
+
+#endif
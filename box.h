@@ -17,14 +17,19 @@ public:
         : box_min(p0), box_max(p1), mat(m) {
     }
 
-    virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const override;
+    virtual bool intersect(const ray& r, interval ray_t, hit_candidate& candidate) const override;
+    virtual void complete_hit(const ray& r, double t, hit_record& rec) const override;
+
+    aabb bounding_box() const override { return aabb(box_min, box_max); }
+
+    void collect_materials(std::vector<const material*>& out) const override { out.push_back(mat.get()); }
 
     point3 box_min;
     point3 box_max;
     shared_ptr<material> mat;
 };
 
-bool box::hit(const ray& r, interval ray_t, hit_record& rec) const {
+bool box::intersect(const ray& r, interval ray_t, hit_candidate& candidate) const {
     double t_min = ray_t.min;
     double t_max = ray_t.max;
 
@@ -43,7 +48,13 @@ bool box::hit(const ray& r, interval ray_t, hit_record& rec) const {
             return false;
     }
 
-    rec.t = t_min;
+    candidate.t = t_min;
+    candidate.object = this;
+    return true;
+}
+
+void box::complete_hit(const ray& r, double t, hit_record& rec) const {
+    rec.t = t;
     rec.p = r.at(rec.t);
 
     vec3 outward_normal;
@@ -70,8 +81,6 @@ bool box::hit(const ray& r, interval ray_t, hit_record& rec) const {
 
     rec.set_face_normal(r, outward_normal);
     rec.mat = mat;  // Asigna el material de este cubo al registro.
-
-    return true;
 }
 
 #endif
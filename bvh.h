@@ -0,0 +1,514 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "rtweekend.h"
+#include "aabb.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Nodo plano del BVH. Se usa el mismo formato en memoria y en el archivo de cache.
+struct bvh_node {
+    double bounds_min[3];
+    double bounds_max[3];
+    std::int32_t first;    // Hoja: primer primitivo. Interior: hijo izquierdo (el derecho es first + 1).
+    std::int32_t count;    // Primitivos de la hoja; 0 en nodos interiores.
+    std::int32_t axis;     // Eje de particion, decide que hijo se visita primero.
+    std::int32_t pad;
+};
+
+// Cabecera del archivo de cache, seguida de los nodos y de los indices de primitivos.
+struct bvh_cache_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t node_size;
+    std::uint64_t scene_key;
+    std::uint64_t node_count;
+    std::uint64_t prim_count;
+    std::uint64_t checksum;  // FNV-1a de nodos e indices.
+};
+
+static_assert(sizeof(bvh_node) == 64, "bvh_node debe tener un tamano fijo para la cache");
+static_assert(sizeof(bvh_cache_header) == 48, "bvh_cache_header debe tener un tamano fijo");
+
+inline std::uint64_t fnv1a(const void* data, std::size_t size,
+                           std::uint64_t hash = 14695981039346656037ull) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Jerarquia de volumenes envolventes sobre los objetos de un hittable_list.
+// Se construye en paralelo con SAH por bins sobre los centroides. Si se indica
+// cache_dir, el arbol se guarda en un archivo identificado por el contenido de la
+// escena y los siguientes arranques lo proyectan en memoria sin reconstruirlo.
+// Los objetos sin limites (planos) o enormes frente al resto se quedan fuera de la
+// jerarquia, en una lista que se prueba siempre, para no inflar las cajas de los nodos.
+class bvh_accel : public hittable {
+public:
+    explicit bvh_accel(const hittable_list& list, const std::string& cache_dir = "") {
+        const auto& objects = list.objects;
+        std::vector<aabb> boxes;
+        boxes.reserve(objects.size());
+        for (const auto& object : objects)
+            boxes.push_back(object->bounding_box());
+        bbox = list.bounding_box();
+
+        std::vector<std::int32_t> bounded;
+        split_unbounded(objects, boxes, bounded);
+        if (bounded.empty())
+            return;
+
+        std::uint64_t key = scene_key(boxes);
+        if (!cache_dir.empty()) {
+            path = cache_dir + "/bvh-" + to_hex(key) + ".bvhcache";
+            from_cache = load_cache(key, objects, bounded.size());
+        }
+
+        if (!from_cache) {
+            build(boxes, bounded);
+            primitives.reserve(bounded.size());
+            for (auto i : owned_indices)
+                primitives.push_back(objects[i]);
+            if (!path.empty())
+                save_cache(key);
+        }
+    }
+
+    bool intersect(const ray& r, interval ray_t, hit_candidate& candidate) const override {
+        bool hit_anything = false;
+
+        // Primero los objetos fuera de la jerarquia: un impacto acorta ray_t para el BVH.
+        for (const auto& object : unbounded) {
+            if (object->intersect(r, ray_t, candidate)) {
+                hit_anything = true;
+                ray_t.max = candidate.t;
+            }
+        }
+
+        if (node_total == 0)
+            return hit_anything;
+
+        const point3& orig = r.origin();
+        const vec3& dir = r.direction();
+        const double inv_dir[3] = { 1.0 / dir[0], 1.0 / dir[1], 1.0 / dir[2] };
+        const double origin[3] = { orig[0], orig[1], orig[2] };
+
+        int stack[max_tree_depth + 1];
+        int stack_size = 0;
+        int current = 0;
+
+        while (true) {
+            const bvh_node& node = nodes[current];
+            if (hit_node(node, origin, inv_dir, ray_t)) {
+                if (node.count > 0) {
+                    for (int i = node.first; i < node.first + node.count; i++) {
+                        if (primitives[i]->intersect(r, ray_t, candidate)) {
+                            hit_anything = true;
+                            ray_t.max = candidate.t;
+                        }
+                    }
+                }
+                else {
+                    // Primero el hijo mas cercano segun el signo del rayo en el eje de particion.
+                    if (inv_dir[node.axis] < 0) {
+                        stack[stack_size++] = node.first;
+                        current = node.first + 1;
+                    }
+                    else {
+                        stack[stack_size++] = node.first + 1;
+                        current = node.first;
+                    }
+                    continue;
+                }
+            }
+            if (stack_size == 0)
+                break;
+            current = stack[--stack_size];
+        }
+
+        return hit_anything;
+    }
+
+    aabb bounding_box() const override { return bbox; }
+
+    void collect_materials(std::vector<const material*>& out) const override {
+        for (const auto& object : unbounded)
+            object->collect_materials(out);
+        for (const auto& object : primitives)
+            object->collect_materials(out);
+    }
+
+    bool loaded_from_cache() const { return from_cache; }
+    std::size_t node_count() const { return node_total; }
+    std::size_t unbounded_count() const { return unbounded.size(); }
+    const std::string& cache_path() const { return path; }
+
+private:
+    static const int cache_version = 2;
+    static const int bin_count = 16;
+    static const int max_leaf_size = 4;
+    static const int max_forced_leaf = 16;      // Sin particion util, una hoja puede crecer hasta aqui.
+    static const int max_tree_depth = 63;       // Tamano de la pila de recorrido.
+    static const int parallel_threshold = 4096; // Subarboles menores se construyen en el mismo hilo.
+    static const int large_area_factor = 1000;  // Area frente a la mediana para quedar fuera.
+
+    std::vector<shared_ptr<hittable>> primitives;  // Reordenados segun las hojas.
+    std::vector<shared_ptr<hittable>> unbounded;   // Siempre se prueban, fuera del arbol.
+    std::vector<bvh_node> owned_nodes;
+    std::vector<std::int32_t> owned_indices;
+    mapped_file cache_file;
+    const bvh_node* nodes = nullptr;
+    std::size_t node_total = 0;
+    aabb bbox;
+    std::string path;
+    bool from_cache = false;
+
+    static bool hit_node(const bvh_node& node, const double* orig, const double* inv_dir, interval ray_t) {
+        for (int a = 0; a < 3; a++) {
+            double t0 = (node.bounds_min[a] - orig[a]) * inv_dir[a];
+            double t1 = (node.bounds_max[a] - orig[a]) * inv_dir[a];
+            if (inv_dir[a] < 0)
+                std::swap(t0, t1);
+            if (t0 > ray_t.min) ray_t.min = t0;
+            if (t1 < ray_t.max) ray_t.max = t1;
+            if (ray_t.max < ray_t.min)
+                return false;
+        }
+        return true;
+    }
+
+    // --- Construccion ---
+
+    // Separa los objetos sin limites finitos o con un area mucho mayor que la mediana;
+    // en `bounded` quedan los indices del resto.
+    void split_unbounded(const std::vector<shared_ptr<hittable>>& objects,
+                         const std::vector<aabb>& boxes, std::vector<std::int32_t>& bounded) {
+        std::vector<double> areas;
+        for (const auto& b : boxes) {
+            double area = b.surface_area();
+            if (area < infinity)
+                areas.push_back(area);
+        }
+
+        double limit = infinity;
+        if (!areas.empty()) {
+            auto median = areas.begin() + areas.size() / 2;
+            std::nth_element(areas.begin(), median, areas.end());
+            if (*median > 0)
+                limit = large_area_factor * *median;
+        }
+
+        for (std::size_t i = 0; i < objects.size(); i++) {
+            double area = boxes[i].surface_area();
+            if (area < infinity && area <= limit)
+                bounded.push_back(std::int32_t(i));
+            else
+                unbounded.push_back(objects[i]);
+        }
+    }
+
+    struct build_state {
+        const std::vector<aabb>& boxes;
+        std::vector<point3> centroids;
+        std::vector<std::int32_t>& indices;
+        std::vector<bvh_node>& nodes;
+        std::atomic<int> next_node;
+        int parallel_depth;
+    };
+
+    void build(const std::vector<aabb>& boxes, const std::vector<std::int32_t>& bounded) {
+        int n = int(bounded.size());
+        owned_indices = bounded;
+        owned_nodes.resize(2 * n - 1);
+
+        build_state state{ boxes, {}, owned_indices, owned_nodes, {1}, 0 };
+        state.centroids.reserve(boxes.size());
+        for (const auto& b : boxes)
+            state.centroids.push_back(b.centroid());
+
+        // Suficientes niveles paralelos para ocupar todos los hilos con algo de margen.
+        int threads = std::max(1u, std::thread::hardware_concurrency());
+        while ((1 << state.parallel_depth) < 4 * threads)
+            state.parallel_depth++;
+
+        build_node(state, 0, 0, n, 0);
+
+        owned_nodes.resize(state.next_node.load());
+        nodes = owned_nodes.data();
+        node_total = owned_nodes.size();
+    }
+
+    static void make_leaf(bvh_node& node, int begin, int end) {
+        node.first = begin;
+        node.count = end - begin;
+        node.axis = 0;
+    }
+
+    static void build_node(build_state& state, int index, int begin, int end, int depth) {
+        bvh_node& node = state.nodes[index];
+        node.pad = 0;
+
+        aabb bounds;
+        aabb centroid_bounds;
+        for (int i = begin; i < end; i++) {
+            int prim = state.indices[i];
+            bounds = aabb(bounds, state.boxes[prim]);
+            centroid_bounds = aabb(centroid_bounds, aabb(state.centroids[prim], state.centroids[prim]));
+        }
+        for (int a = 0; a < 3; a++) {
+            node.bounds_min[a] = bounds.axis_interval(a).min;
+            node.bounds_max[a] = bounds.axis_interval(a).max;
+        }
+
+        int count = end - begin;
+        if (count <= max_leaf_size || depth >= max_tree_depth) {
+            make_leaf(node, begin, end);
+            return;
+        }
+
+        // SAH por bins: se evaluan bin_count - 1 planos en cada eje.
+        int best_axis = -1;
+        int best_split = 0;
+        double best_cost = infinity;
+        for (int axis = 0; axis < 3; axis++) {
+            const interval& extent = centroid_bounds.axis_interval(axis);
+            if (extent.size() <= 0)
+                continue;
+
+            int bin_counts[bin_count] = {};
+            aabb bin_bounds[bin_count];
+            double scale = bin_count / extent.size();
+            for (int i = begin; i < end; i++) {
+                int prim = state.indices[i];
+                int b = bin_of(state.centroids[prim][axis], extent.min, scale);
+                bin_counts[b]++;
+                bin_bounds[b] = aabb(bin_bounds[b], state.boxes[prim]);
+            }
+
+            // Barrido de derecha a izquierda para el coste del lado derecho.
+            double right_cost[bin_count];
+            aabb right_box;
+            int right_count = 0;
+            for (int b = bin_count - 1; b > 0; b--) {
+                right_box = aabb(right_box, bin_bounds[b]);
+                right_count += bin_counts[b];
+                right_cost[b] = right_count * right_box.surface_area();
+            }
+
+            aabb left_box;
+            int left_count = 0;
+            for (int b = 0; b < bin_count - 1; b++) {
+                left_box = aabb(left_box, bin_bounds[b]);
+                left_count += bin_counts[b];
+                if (left_count == 0 || left_count == count)
+                    continue;
+                double cost = left_count * left_box.surface_area() + right_cost[b + 1];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b + 1;
+                }
+            }
+        }
+
+        int mid;
+        double area = bounds.surface_area();
+        double leaf_cost = count;
+        double split_cost = area > 0 ? 1.0 + best_cost / area : infinity;
+
+        if (best_axis >= 0 && (split_cost < leaf_cost || count > max_forced_leaf)) {
+            const interval& extent = centroid_bounds.axis_interval(best_axis);
+            double scale = bin_count / extent.size();
+            auto first = state.indices.begin() + begin;
+            auto last = state.indices.begin() + end;
+            auto split = std::partition(first, last, [&](std::int32_t prim) {
+                return bin_of(state.centroids[prim][best_axis], extent.min, scale) < best_split;
+            });
+            mid = int(split - state.indices.begin());
+        }
+        else if (count <= max_forced_leaf) {
+            make_leaf(node, begin, end);
+            return;
+        }
+        else {
+            // Todos los centroides coinciden: se reparte por la mitad.
+            mid = begin + count / 2;
+            best_axis = 0;
+        }
+
+        int left = state.next_node.fetch_add(2);
+        node.first = left;
+        node.count = 0;
+        node.axis = best_axis;
+
+        if (count > parallel_threshold && depth < state.parallel_depth) {
+            auto left_task = std::async(std::launch::async, [&state, left, begin, mid, depth] {
+                build_node(state, left, begin, mid, depth + 1);
+            });
+            build_node(state, left + 1, mid, end, depth + 1);
+            left_task.get();
+        }
+        else {
+            build_node(state, left, begin, mid, depth + 1);
+            build_node(state, left + 1, mid, end, depth + 1);
+        }
+    }
+
+    static int bin_of(double centroid, double extent_min, double scale) {
+        int b = int((centroid - extent_min) * scale);
+        return b < 0 ? 0 : (b >= bin_count ? bin_count - 1 : b);
+    }
+
+    // --- Cache ---
+
+    static std::uint64_t scene_key(const std::vector<aabb>& boxes) {
+        // El arbol solo depende de la geometria envolvente y de los parametros de construccion.
+        std::int32_t params[6] = { cache_version, bin_count, max_leaf_size, max_forced_leaf,
+                                   large_area_factor, max_tree_depth };
+        std::uint64_t key = fnv1a(params, sizeof(params));
+        std::uint64_t count = boxes.size();
+        key = fnv1a(&count, sizeof(count), key);
+        for (const auto& b : boxes) {
+            double values[6] = { b.x.min, b.x.max, b.y.min, b.y.max, b.z.min, b.z.max };
+            key = fnv1a(values, sizeof(values), key);
+        }
+        return key;
+    }
+
+    static std::string to_hex(std::uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    bool load_cache(std::uint64_t key, const std::vector<shared_ptr<hittable>>& objects,
+                    std::size_t bounded_count) {
+        if (!cache_file.open(path))
+            return false;
+
+        bvh_cache_header header;
+        if (cache_file.size() < sizeof(header)) {
+            cache_file.close();
+            return false;
+        }
+        std::memcpy(&header, cache_file.data(), sizeof(header));
+
+        const unsigned char* payload = cache_file.data() + sizeof(header);
+        std::size_t node_bytes = std::size_t(header.node_count) * sizeof(bvh_node);
+        std::size_t index_bytes = std::size_t(header.prim_count) * sizeof(std::int32_t);
+        bool valid = std::memcmp(header.magic, "RTBVH\0\0\0", 8) == 0
+            && header.version == cache_version
+            && header.node_size == sizeof(bvh_node)
+            && header.scene_key == key
+            && header.prim_count == bounded_count
+            && header.node_count > 0
+            && cache_file.size() == sizeof(header) + node_bytes + index_bytes
+            && header.checksum == fnv1a(payload, node_bytes + index_bytes)
+            && valid_tree(reinterpret_cast<const bvh_node*>(payload), std::size_t(header.node_count),
+                          std::size_t(header.prim_count));
+        if (!valid) {
+            cache_file.close();
+            return false;
+        }
+
+        std::vector<std::int32_t> indices(header.prim_count);
+        std::memcpy(indices.data(), payload + node_bytes, index_bytes);
+        primitives.reserve(indices.size());
+        for (auto i : indices) {
+            if (i < 0 || std::size_t(i) >= objects.size()) {
+                primitives.clear();
+                cache_file.close();
+                return false;
+            }
+            primitives.push_back(objects[i]);
+        }
+
+        nodes = reinterpret_cast<const bvh_node*>(payload);
+        node_total = std::size_t(header.node_count);
+        return true;
+    }
+
+    // Comprueba que el recorrido de hit() no salga de los nodos, de los primitivos ni de
+    // su pila: hijos dentro del arreglo y posteriores al padre (asi no hay ciclos), hojas
+    // dentro de los primitivos, profundidad <= max_tree_depth y cada nodo visitado una vez.
+    static bool valid_tree(const bvh_node* tree, std::size_t node_count, std::size_t prim_count) {
+        std::vector<std::pair<std::size_t, int>> pending(1, std::make_pair(std::size_t(0), 0));
+        std::size_t visited = 0;
+        while (!pending.empty()) {
+            std::size_t index = pending.back().first;
+            int depth = pending.back().second;
+            pending.pop_back();
+            if (++visited > node_count)
+                return false;
+
+            const bvh_node& node = tree[index];
+            if (node.count > 0) {
+                if (node.first < 0 || std::size_t(node.first) + std::size_t(node.count) > prim_count)
+                    return false;
+            }
+            else {
+                if (node.count < 0 || node.axis < 0 || node.axis > 2 || depth >= max_tree_depth)
+                    return false;
+                if (node.first < 0 || std::size_t(node.first) <= index
+                    || std::size_t(node.first) + 1 >= node_count)
+                    return false;
+                pending.emplace_back(std::size_t(node.first), depth + 1);
+                pending.emplace_back(std::size_t(node.first) + 1, depth + 1);
+            }
+        }
+        return visited == node_count;
+    }
+
+    void save_cache(std::uint64_t key) const {
+        std::size_t node_bytes = owned_nodes.size() * sizeof(bvh_node);
+        std::size_t index_bytes = owned_indices.size() * sizeof(std::int32_t);
+
+        bvh_cache_header header;
+        std::memcpy(header.magic, "RTBVH\0\0\0", 8);
+        header.version = cache_version;
+        header.node_size = sizeof(bvh_node);
+        header.scene_key = key;
+        header.node_count = owned_nodes.size();
+        header.prim_count = owned_indices.size();
+        header.checksum = fnv1a(owned_indices.data(), index_bytes,
+                                fnv1a(owned_nodes.data(), node_bytes));
+
+        // Se escribe aparte y se renombra para no dejar nunca un archivo a medias.
+        std::string temp_path = path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary);
+            if (!out.is_open()) {
+                std::cerr << "Aviso: no se pudo escribir la cache " << path << "\n";
+                return;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(owned_nodes.data()), std::streamsize(node_bytes));
+            out.write(reinterpret_cast<const char*>(owned_indices.data()), std::streamsize(index_bytes));
+            if (!out) {
+                out.close();
+                std::remove(temp_path.c_str());
+                return;
+            }
+        }
+        std::remove(path.c_str());
+        std::rename(temp_path.c_str(), path.c_str());
+    }
+};
+
+#endif
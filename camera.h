@@ -3,13 +3,23 @@
 
 #include "hittable.h"
 #include "material.h"
+#include "metal.h"
 #include "vec3.h"
 #include "ray.h"
 #include "interval.h"
 #include "rtweekend.h"
+#include "band_writer.h"
+#include "radiance_cache.h"
+#include "path_guide.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 class camera {
 public:
@@ -27,34 +37,142 @@ public:
     double defocus_angle = 0;      // ngulo del cono de variacin 
     double focus_dist = 10;        // Distancia al plano de enfoque.
 
-    void render(const hittable& world, std::ostream& out = std::cout) {
+    // Salida por bandas: varios hilos renderizan bandas horizontales y un hilo
+    // escritor las vuelca en orden. La memoria depende de band_height, no del tamano.
+    bool stream_output = false;
+    int band_height = 16;          // Filas por banda.
+    int render_threads = 0;        // 0 = std::thread::hardware_concurrency().
+    int max_pending_bands = 0;     // Bandas terminadas en espera de escritura; 0 = 2 * hilos.
+
+    // Si se indica, el render se detiene (entre filas o bandas) cuando pasa a true.
+    const std::atomic<bool>* cancel_flag = nullptr;
+    bool log_progress = true;      // Mensajes de progreso en std::clog.
+
+    // Cache de radiancia opcional: desde el rebote cache_min_bounce, los impactos en
+    // materiales difusos reutilizan la luz incidente cacheada en vez de seguir trazando.
+    // Cada render empieza con una cache vacia; no se heredan valores de otros renders.
+    bool radiance_caching = false;
+    int cache_min_bounce = 1;
+
+    // Guia de caminos opcional: antes del render se hacen pases de entrenamiento
+    // (1, 2, 4... muestras por pixel) y los rebotes difusos mezclan la distribucion
+    // aprendida con el muestreo coseno. El render final sigue aprendiendo y la guia se
+    // refina entre rondas de filas. Cada render empieza con una guia propia, asi que
+    // las copias de la camara pueden renderizar en paralelo.
+    bool path_guiding = false;
+    int guide_training_passes = 3;
+    double guide_fraction = 0.5;   // Probabilidad de muestrear la guia en vez del material.
+
+    bool cancelled() const {
+        return cancel_flag && cancel_flag->load(std::memory_order_relaxed);
+    }
+
+    // Devuelve false si no se pudo escribir la imagen en `out`.
+    bool render(const hittable& world, std::ostream& out = std::cout) {
+        if (stream_output)
+            return render_streaming(world, out);
+
         initialize();
+        kernel = select_kernel(world);
+        train_guide(world);
 
         out << "P3\n" << image_width << " " << image_height << "\n255\n";
 
-        for (int j = 0; j < image_height; j++) {
-            std::clog << "\rScanlines remaining: " << (image_height - j) << " " << std::flush;
+        // Con guia se refina tras band_height filas, luego tras el doble, etc.
+        int refine_row = std::max(1, band_height);
+        for (int j = 0; j < image_height && !cancelled() && out; j++) {
+            if (guide && j == refine_row) {
+                guide->refine();
+                refine_row *= 2;
+            }
+            if (log_progress)
+                std::clog << "\rScanlines remaining: " << (image_height - j) << " " << std::flush;
             for (int i = 0; i < image_width; i++) {
-                color pixel_color(0, 0, 0);
-                for (int s = 0; s < samples_per_pixel; s++) {
-                    ray r = get_ray(i, j);
-                    pixel_color += ray_color(r, max_depth, world);
-                }
+                color pixel_color = (this->*kernel)(i, j, world);
                 write_color(out, pixel_samples_scale * pixel_color);
             }
         }
-        std::clog << "\rDone.                 \n";
+        if (log_progress)
+            std::clog << "\rDone.                 \n";
+        return bool(out);
     }
 
-    void render_to_file(const hittable& world, const std::string& filename) {
+    bool render_streaming(const hittable& world, std::ostream& out = std::cout) {
+        initialize();
+        kernel = select_kernel(world);
+        train_guide(world);
+
+        out << "P3\n" << image_width << " " << image_height << "\n255\n";
+
+        int rows_per_band = std::max(1, band_height);
+        int band_count = (image_height + rows_per_band - 1) / rows_per_band;
+        int thread_count = worker_count(band_count);
+        int pending_limit = max_pending_bands > 0 ? max_pending_bands : 2 * thread_count;
+
+        band_writer writer(out, pending_limit);
+        std::atomic<int> bands_done(0);
+        std::mutex log_mutex;
+
+        // Sin guia todas las bandas forman una sola ronda. Con guia las rondas crecen
+        // (1, 2, 4... bandas por hilo) y la guia se refina entre una y otra, cuando
+        // ningun hilo la esta leyendo.
+        int round_size = guide ? thread_count : band_count;
+        for (int first = 0; first < band_count && !cancelled() && !writer.failed(); round_size *= 2) {
+            int last = std::min(first + round_size, band_count);
+            std::atomic<int> next_band(first);
+
+            auto worker = [&] {
+                // Una banda tomada siempre se entrega: el escritor espera a que lleguen en orden.
+                while (!cancelled() && !writer.failed()) {
+                    int band = next_band++;
+                    if (band >= last)
+                        break;
+                    int j0 = band * rows_per_band;
+                    int j1 = std::min(j0 + rows_per_band, image_height);
+                    writer.submit(band, render_band(world, j0, j1));
+
+                    int remaining = band_count - ++bands_done;
+                    if (log_progress) {
+                        std::lock_guard<std::mutex> lock(log_mutex);
+                        std::clog << "\rBands remaining: " << remaining << " " << std::flush;
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (int t = 1; t < std::min(thread_count, last - first); t++)
+                threads.emplace_back(worker);
+            worker();
+            for (auto& t : threads)
+                t.join();
+
+            if (guide && last < band_count)
+                guide->refine();
+            first = last;
+        }
+        writer.finish();
+
+        if (log_progress)
+            std::clog << (cancelled() ? "\rCancelled.            \n" : "\rDone.                 \n");
+        return !writer.failed() && bool(out);
+    }
+
+    bool render_to_file(const hittable& world, const std::string& filename) {
         std::ofstream out_file(filename);
         if (!out_file.is_open()) {
             std::cerr << "Error: No se pudo abrir el archivo " << filename << " para escritura.\n";
-            return;
+            return false;
         }
-        render(world, out_file);
+        bool written = render(world, out_file);
         out_file.close();
+        if (!written || !out_file) {
+            std::cerr << "Error: No se pudo escribir el archivo " << filename << ".\n";
+            return false;
+        }
+        if (cancelled() || !log_progress)
+            return true;
         std::clog << "Imagen guardada en '" << filename << "'\n";
+        return true;
     }
 
 private:
@@ -70,12 +188,57 @@ private:
     vec3 defocus_disk_u;
     vec3 defocus_disk_v;
 
+    // Cache y guia del render en curso; las crea initialize() segun radiance_caching
+    // y path_guiding.
+    shared_ptr<radiance_cache> cache;
+    shared_ptr<path_guide> guide;
+
+    // Kernel de pixel elegido al empezar cada render (ver select_kernel).
+    using pixel_kernel = color (camera::*)(int, int, const hittable&) const;
+    pixel_kernel kernel = &camera::pixel_generic;
+
+    int worker_count(int tasks) const {
+        int threads = render_threads > 0 ? render_threads : int(std::thread::hardware_concurrency());
+        return std::max(1, std::min(threads, tasks));
+    }
+
+    // Pases de entrenamiento de la guia. Los hilos aprenden en paralelo, la imagen se
+    // descarta y entre pase y pase la guia congela y subdivide lo aprendido. La guia
+    // no se refina nunca mientras algun hilo la usa.
+    void train_guide(const hittable& world) {
+        if (!guide)
+            return;
+
+        for (int pass = 0; pass < guide_training_passes && !cancelled(); pass++) {
+            int spp = std::min(1 << pass, samples_per_pixel);
+            std::atomic<int> next_row(0);
+            auto worker = [&] {
+                for (int j = next_row++; j < image_height && !cancelled(); j = next_row++)
+                    for (int i = 0; i < image_width; i++)
+                        for (int s = 0; s < spp; s++)
+                            ray_color(get_ray(i, j), max_depth, world);
+            };
+
+            std::vector<std::thread> threads;
+            for (int t = 1; t < worker_count(image_height); t++)
+                threads.emplace_back(worker);
+            worker();
+            for (auto& t : threads)
+                t.join();
+
+            guide->refine();
+        }
+    }
+
     void initialize() {
         image_height = int(image_width / aspect_ratio);
         if (image_height < 1)
             image_height = 1;
         pixel_samples_scale = 1.0 / samples_per_pixel;
 
+        cache = radiance_caching ? make_shared<radiance_cache>() : nullptr;
+        guide = path_guiding ? make_shared<path_guide>() : nullptr;
+
         center = lookfrom;
 
         // Calcula la distancia focal como la longitud entre lookfrom y lookat.
@@ -106,13 +269,143 @@ private:
         defocus_disk_v = v * defocus_radius;
     }
 
+    // Renderiza las filas [j0, j1) y devuelve su texto PPM.
+    std::string render_band(const hittable& world, int j0, int j1) const {
+        std::ostringstream band;
+        for (int j = j0; j < j1; j++) {
+            for (int i = 0; i < image_width; i++) {
+                color pixel_color = (this->*kernel)(i, j, world);
+                write_color(band, pixel_samples_scale * pixel_color);
+            }
+        }
+        return band.str();
+    }
+
+    // --- Kernels de pixel ---
+    //
+    // Lo que no cambia durante un render (desenfoque, materiales presentes en la
+    // escena, max_depth) se fija como parametro de plantilla, asi el compilador
+    // elimina las ramas muertas y despacha los materiales sin llamadas virtuales.
+    // Con cache, guia o materiales desconocidos se usa el kernel generico.
+
+    pixel_kernel select_kernel(const hittable& world) const {
+        if (cache || guide)
+            return &camera::pixel_generic;
+
+        std::vector<const material*> materials;
+        world.collect_materials(materials);
+        bool has_dielectric = false;
+        bool has_fuzz = false;
+        for (const material* m : materials) {
+            if (!m)
+                continue;
+            switch (m->kind) {
+            case material_kind::lambertian:
+                break;
+            case material_kind::metal:
+                has_fuzz = has_fuzz || static_cast<const metal*>(m)->fuzz_amount() > 0;
+                break;
+            case material_kind::dielectric:
+                has_dielectric = true;
+                break;
+            default:
+                return &camera::pixel_generic;
+            }
+        }
+
+        if (defocus_angle > 0)
+            return select_kernel_for<true>(has_dielectric, has_fuzz);
+        return select_kernel_for<false>(has_dielectric, has_fuzz);
+    }
+
+    template <bool Defocus>
+    pixel_kernel select_kernel_for(bool has_dielectric, bool has_fuzz) const {
+        if (has_dielectric)
+            return has_fuzz ? select_kernel_for<Defocus, true, true>() : select_kernel_for<Defocus, true, false>();
+        return has_fuzz ? select_kernel_for<Defocus, false, true>() : select_kernel_for<Defocus, false, false>();
+    }
+
+    // Profundidades habituales con limite fijo; el resto usa max_depth en tiempo de ejecucion.
+    template <bool Defocus, bool Dielectric, bool Fuzz>
+    pixel_kernel select_kernel_for() const {
+        switch (max_depth) {
+        case 10: return &camera::pixel_specialized<Defocus, Dielectric, Fuzz, 10>;
+        case 25: return &camera::pixel_specialized<Defocus, Dielectric, Fuzz, 25>;
+        case 50: return &camera::pixel_specialized<Defocus, Dielectric, Fuzz, 50>;
+        default: return &camera::pixel_specialized<Defocus, Dielectric, Fuzz, 0>;
+        }
+    }
+
+    color pixel_generic(int i, int j, const hittable& world) const {
+        color pixel_color(0, 0, 0);
+        for (int s = 0; s < samples_per_pixel; s++) {
+            ray r = get_ray(i, j);
+            pixel_color += ray_color(r, max_depth, world);
+        }
+        return pixel_color;
+    }
+
+    template <bool Defocus, bool Dielectric, bool Fuzz, int MaxDepth>
+    color pixel_specialized(int i, int j, const hittable& world) const {
+        color pixel_color(0, 0, 0);
+        for (int s = 0; s < samples_per_pixel; s++) {
+            ray r = get_ray_with<Defocus>(i, j);
+            pixel_color += trace_path<Dielectric, Fuzz, MaxDepth>(r, world);
+        }
+        return pixel_color;
+    }
+
+    // Version iterativa de ray_color sin cache ni guia: acumula la atenuacion del camino.
+    template <bool Dielectric, bool Fuzz, int MaxDepth>
+    color trace_path(ray r, const hittable& world) const {
+        const int depth_limit = MaxDepth > 0 ? MaxDepth : max_depth;
+        color throughput(1, 1, 1);
+        hit_record rec;
+        for (int depth = 0; depth < depth_limit; depth++) {
+            if (!world.hit(r, interval(0.001, infinity), rec))
+                return throughput * background(r);
+
+            ray scattered;
+            color attenuation;
+            if (!rec.mat || !scatter_with<Dielectric, Fuzz>(*rec.mat, r, rec, attenuation, scattered))
+                return color(0, 0, 0);
+            throughput = throughput * attenuation;
+            r = scattered;
+        }
+        return color(0, 0, 0);
+    }
+
+    // Llamadas calificadas: no son virtuales y el compilador puede expandirlas.
+    template <bool Dielectric, bool Fuzz>
+    static bool scatter_with(const material& m, const ray& r_in, const hit_record& rec,
+                             color& attenuation, ray& scattered) {
+        switch (m.kind) {
+        case material_kind::lambertian:
+            return static_cast<const lambertian&>(m).lambertian::scatter(r_in, rec, attenuation, scattered);
+        case material_kind::metal:
+            return static_cast<const metal&>(m).scatter_with<Fuzz>(r_in, rec, attenuation, scattered);
+        case material_kind::dielectric:
+            if (Dielectric)
+                return static_cast<const dielectric&>(m).dielectric::scatter(r_in, rec, attenuation, scattered);
+            break;
+        default:
+            break;
+        }
+        return m.scatter(r_in, rec, attenuation, scattered);
+    }
+
     ray get_ray(int i, int j) const {
+        return defocus_angle > 0 ? get_ray_with<true>(i, j) : get_ray_with<false>(i, j);
+    }
+
+    template <bool Defocus>
+    ray get_ray_with(int i, int j) const {
         auto offset = sample_square();
         auto pixel_sample = pixel00_loc
             + ((i + offset.x()) * pixel_delta_u)
             + ((j + offset.y()) * pixel_delta_v);
         point3 ray_origin = center;
-        if (defocus_angle > 0)
+        if (Defocus)
             ray_origin = defocus_disk_sample();
         auto ray_direction = pixel_sample - ray_origin;
         return ray(ray_origin, ray_direction);
@@ -136,14 +429,63 @@ private:
         if (world.hit(r, interval(0.001, infinity), rec)) {
             ray scattered;
             color attenuation;
-            if (rec.mat && rec.mat->scatter(r, rec, attenuation, scattered))
-                return attenuation * ray_color(scattered, depth - 1, world);
-            return color(0, 0, 0);
+            if (!rec.mat || !rec.mat->scatter(r, rec, attenuation, scattered))
+                return color(0, 0, 0);
+            if (rec.mat->is_diffuse())
+                return attenuation * diffuse_incoming(rec, scattered, depth, world);
+            return attenuation * ray_color(scattered, depth - 1, world);
         }
+        return background(r);
+    }
+
+    static color background(const ray& r) {
         vec3 unit_direction = unit_vector(r.direction());
         auto a = 0.5 * (unit_direction.y() + 1.0);
         return (1.0 - a) * color(1.0, 1.0, 1.0) + a * color(0.5, 0.7, 1.0);
     }
+
+    // Luz incidente en un rebote difuso, ya dividida por la densidad relativa al
+    // muestreo coseno del material. Aqui intervienen la cache y la guia de caminos.
+    color diffuse_incoming(const hit_record& rec, ray scattered, int depth, const hittable& world) const {
+        bool use_cache = cache && max_depth - depth >= cache_min_bounce;
+        point3 cache_p;
+        if (use_cache) {
+            cache_p = cache->jitter(rec.p);
+            color cached;
+            if (cache->lookup(cache_p, rec.normal, cached))
+                return cached;
+        }
+
+        color incoming(0, 0, 0);
+
+        if (!guide) {
+            incoming = ray_color(scattered, depth - 1, world);
+        }
+        else {
+            bool guided = guide->ready();
+            if (guided && random_double() < guide_fraction) {
+                double guide_pdf;
+                scattered = ray(rec.p, guide->sample(rec.p, guide_pdf));
+            }
+
+            // Un solo muestreo con la densidad de la mezcla (guia + coseno).
+            vec3 dir = unit_vector(scattered.direction());
+            double cosine_pdf = dot(dir, rec.normal) / pi;
+            if (cosine_pdf > 0) {
+                double sample_pdf = cosine_pdf;
+                if (guided)
+                    sample_pdf = guide_fraction * guide->pdf(rec.p, dir) + (1 - guide_fraction) * cosine_pdf;
+
+                incoming = ray_color(scattered, depth - 1, world);
+                guide->record(rec.p, dir, luminance(incoming), sample_pdf);
+                incoming = (cosine_pdf / sample_pdf) * incoming;
+            }
+        }
+
+        if (use_cache)
+            cache->add(cache_p, rec.normal, incoming);
+        return incoming;
+    }
 };
 
 #endif
@@ -14,6 +14,11 @@ inline double linear_to_gamma(double linear_component) {
     return 0;
 }
 
+// Luminancia relativa (Rec. 709) de un color lineal.
+inline double luminance(const color& c) {
+    return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
 void write_color(std::ostream& out, const color& pixel_color) {
     // Aplicar correccin gamma a cada componente
     auto r = linear_to_gamma(pixel_color.x());
@@ -2,11 +2,13 @@
 #define HITTABLE_H
 
 #include <memory>
+#include <vector>
 using std::shared_ptr;
 
 #include "vec3.h"
 #include "ray.h"
 #include "interval.h"
+#include "aabb.h"
 
 
 class material;
@@ -25,10 +27,40 @@ public:
     }
 };
 
+class hittable;
+
+// Resultado de la fase barata de interseccion: distancia y primitivo alcanzado.
+struct hit_candidate {
+    double t;
+    const hittable* object;
+};
+
 class hittable {
 public:
     virtual ~hittable() = default;
-    virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const = 0;
+
+    // Fase 1: busca el impacto mas cercano en ray_t sin calcular atributos.
+    // Las colecciones devuelven el primitivo concreto, no a si mismas.
+    virtual bool intersect(const ray& r, interval ray_t, hit_candidate& candidate) const = 0;
+
+    // Fase 2: posicion, normal, cara y material, solo para el impacto ganador.
+    virtual void complete_hit(const ray& r, double t, hit_record& rec) const {
+        rec.t = t;
+        rec.p = r.at(t);
+    }
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const {
+        hit_candidate candidate;
+        if (!intersect(r, ray_t, candidate))
+            return false;
+        candidate.object->complete_hit(r, candidate.t, rec);
+        return true;
+    }
+
+    virtual aabb bounding_box() const = 0;
+
+    // Anade a out los materiales usados, para que camera elija su kernel.
+    virtual void collect_materials(std::vector<const material*>& out) const = 0;
 };
 
 #endif
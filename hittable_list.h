@@ -13,27 +13,38 @@ public:
     hittable_list() {}
     hittable_list(shared_ptr<hittable> object) { add(object); }
 
-    void clear() { objects.clear(); }
+    void clear() {
+        objects.clear();
+        bbox = aabb();
+    }
 
     void add(shared_ptr<hittable> object) {
         objects.push_back(object);
+        bbox = aabb(bbox, object->bounding_box());
     }
 
-    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-        hit_record temp_rec;
+    bool intersect(const ray& r, interval ray_t, hit_candidate& candidate) const override {
         bool hit_anything = false;
-        auto closest_so_far = ray_t.max;
 
         for (const auto& object : objects) {
-            if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
+            if (object->intersect(r, ray_t, candidate)) {
                 hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
+                ray_t.max = candidate.t;
             }
         }
 
         return hit_anything;
     }
+
+    aabb bounding_box() const override { return bbox; }
+
+    void collect_materials(std::vector<const material*>& out) const override {
+        for (const auto& object : objects)
+            object->collect_materials(out);
+    }
+
+private:
+    aabb bbox;
 };
 
 #endif#pragma once
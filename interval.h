@@ -13,6 +13,10 @@ public:
 
     interval(double min, double max) : min(min), max(max) {}
 
+    // Intervalo que contiene a los dos dados.
+    interval(const interval& a, const interval& b)
+        : min(a.min <= b.min ? a.min : b.min), max(a.max >= b.max ? a.max : b.max) {}
+
     double size() const {
         return max - min;
     }
@@ -5,20 +5,31 @@
 #include "vec3.h"
 #include "ray.h"
 
+// Tipo concreto de material, para que los kernels especializados de camera
+// despachen sin llamada virtual.
+enum class material_kind { lambertian, metal, dielectric, other };
+
 // Clase abstracta para materiales.
 class material {
 public:
+    explicit material(material_kind kind = material_kind::other) : kind(kind) {}
     virtual ~material() = default;
+
+    const material_kind kind;
+
     // El mtodo scatter produce el rayo dispersado y la atenuacin (albedo).
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
     ) const = 0;
+
+    // Difuso ideal: la luz saliente no depende de la direccion de entrada.
+    virtual bool is_diffuse() const { return false; }
 };
 
 // Material lambertiano (difuso).
 class lambertian : public material {
 public:
-    lambertian(const color& a) : albedo(a) {}
+    lambertian(const color& a) : material(material_kind::lambertian), albedo(a) {}
 
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
@@ -30,6 +41,8 @@ public:
         attenuation = albedo;
         return true;
     }
+
+    bool is_diffuse() const override { return true; }
 private:
     color albedo;
 };
@@ -38,7 +51,8 @@ private:
 // total internal reflection.
 class dielectric : public material {
 public:
-    dielectric(double refraction_index) : refraction_index(refraction_index) {}
+    dielectric(double refraction_index)
+        : material(material_kind::dielectric), refraction_index(refraction_index) {}
 
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
@@ -17,17 +17,27 @@ inline vec3 random_in_unit_sphere() {
 class metal : public material {
 public:
     // Constructor que acepta el color (albedo) y un factor de fuzz.
-    metal(const color& a, double f) : albedo(a), fuzz(f < 1 ? f : 1) {}
+    metal(const color& a, double f) : material(material_kind::metal), albedo(a), fuzz(f < 1 ? f : 1) {}
 
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
     ) const override {
+        return scatter_with<true>(r_in, rec, attenuation, scattered);
+    }
+
+    // Con Fuzzy = false se omite la perturbacion; solo es exacto si fuzz == 0.
+    template <bool Fuzzy>
+    bool scatter_with(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const {
         vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
-        scattered = ray(rec.p, reflected + fuzz * random_in_unit_sphere());
+        if (Fuzzy)
+            reflected = reflected + fuzz * random_in_unit_sphere();
+        scattered = ray(rec.p, reflected);
         attenuation = albedo;
         return (dot(scattered.direction(), rec.normal) > 0);
     }
 
+    double fuzz_amount() const { return fuzz; }
+
 private:
     color albedo;
     double fuzz;
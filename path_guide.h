@@ -0,0 +1,221 @@
+#ifndef PATH_GUIDE_H
+#define PATH_GUIDE_H
+
+#include "rtweekend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Guia de caminos: aprende durante el render de donde llega la luz. Un arbol kd
+// espacial reparte la escena; cada hoja guarda un histograma direccional sobre la
+// esfera (proyeccion cilindrica de areas iguales, cos(theta) x phi). Los pases de
+// entrenamiento acumulan en paralelo con atomicos; refine() congela lo aprendido como
+// distribucion de muestreo y subdivide las hojas con muchas muestras. El numero de
+// hojas esta acotado por max_leaves, asi que la memoria tambien.
+class path_guide {
+public:
+    explicit path_guide(int max_leaves = 1024, int split_threshold = 4000)
+        : max_leaves(std::max(1, max_leaves)), split_threshold(split_threshold),
+          bins(new std::atomic<double>[std::size_t(this->max_leaves) * bin_total]),
+          stats(new leaf_stats[std::size_t(this->max_leaves)]),
+          cdf(std::size_t(this->max_leaves) * bin_total), cdf_samples(std::size_t(this->max_leaves), 0.0) {
+        nodes.push_back(node{ 0, 0.0, 0, 0 });
+        leaf_total = 1;
+        reset_training();
+    }
+
+    path_guide(const path_guide&) = delete;
+    path_guide& operator=(const path_guide&) = delete;
+
+    // True cuando ya hay una distribucion aprendida para muestrear.
+    bool ready() const { return trained; }
+
+    int leaf_count() const { return leaf_total; }
+
+    // Muestrea una direccion unitaria segun lo aprendido en p y devuelve su densidad.
+    vec3 sample(const point3& p, double& pdf) const {
+        const double* leaf_cdf = &cdf[std::size_t(find_leaf(p)) * bin_total];
+        double xi = random_double();
+        int bin = int(std::upper_bound(leaf_cdf, leaf_cdf + bin_total, xi) - leaf_cdf);
+        bin = std::min(bin, bin_total - 1);
+
+        double u = ((bin / phi_bins) + random_double()) / cos_bins;
+        double v = ((bin % phi_bins) + random_double()) / phi_bins;
+        vec3 dir = direction_of(u, v);
+        pdf = bin_probability(leaf_cdf, bin) * bin_total / (4 * pi);
+        return dir;
+    }
+
+    // Densidad de la distribucion aprendida en p para la direccion unitaria dir.
+    double pdf(const point3& p, const vec3& dir) const {
+        const double* leaf_cdf = &cdf[std::size_t(find_leaf(p)) * bin_total];
+        return bin_probability(leaf_cdf, bin_of(dir)) * bin_total / (4 * pi);
+    }
+
+    // Registra la luminancia que llego a p desde dir, muestreada con densidad pdf.
+    void record(const point3& p, const vec3& dir, double luminance, double sample_pdf) {
+        if (!(luminance > 0) || !(sample_pdf > 0) || !std::isfinite(luminance))
+            return;
+        int leaf = find_leaf(p);
+        atomic_add(bins[std::size_t(leaf) * bin_total + bin_of(dir)], luminance / sample_pdf);
+
+        leaf_stats& s = stats[leaf];
+        for (int a = 0; a < 3; a++) {
+            atomic_add(s.position_sum[a], p[a]);
+            atomic_add(s.position_sq_sum[a], p[a] * p[a]);
+        }
+        s.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Entre pases, sin hilos usando la guia: congela los histogramas como distribucion
+    // de muestreo, subdivide las hojas saturadas y reinicia el entrenamiento. Una hoja
+    // solo cambia de distribucion si ha visto al menos tantas muestras como la actual,
+    // asi que refinar a menudo con pocas muestras no empeora lo aprendido.
+    void refine() {
+        for (int leaf = 0; leaf < leaf_total; leaf++)
+            build_cdf(leaf);
+        trained = true;
+
+        int node_count = int(nodes.size());
+        for (int n = 0; n < node_count && leaf_total < max_leaves; n++) {
+            if (nodes[n].leaf < 0)
+                continue;
+            int leaf = nodes[n].leaf;
+            const leaf_stats& s = stats[leaf];
+            double count = s.count.load(std::memory_order_relaxed);
+            if (count < split_threshold)
+                continue;
+
+            // Se corta en la media, por el eje de mayor varianza de las muestras.
+            int axis = 0;
+            double best_variance = -1;
+            for (int a = 0; a < 3; a++) {
+                double mean = s.position_sum[a].load() / count;
+                double variance = s.position_sq_sum[a].load() / count - mean * mean;
+                if (variance > best_variance) {
+                    best_variance = variance;
+                    axis = a;
+                }
+            }
+            if (!(best_variance > 0))
+                continue;
+
+            int right_leaf = leaf_total++;
+            std::copy(&cdf[std::size_t(leaf) * bin_total], &cdf[std::size_t(leaf + 1) * bin_total],
+                      &cdf[std::size_t(right_leaf) * bin_total]);
+            cdf_samples[leaf] *= 0.5;
+            cdf_samples[right_leaf] = cdf_samples[leaf];
+
+            int child = int(nodes.size());
+            nodes[n].axis = axis;
+            nodes[n].split = s.position_sum[axis].load() / count;
+            nodes[n].child = child;
+            nodes[n].leaf = -1;
+            nodes.push_back(node{ 0, 0.0, 0, leaf });
+            nodes.push_back(node{ 0, 0.0, 0, right_leaf });
+        }
+
+        reset_training();
+    }
+
+private:
+    static const int cos_bins = 8;
+    static const int phi_bins = 16;
+    static const int bin_total = cos_bins * phi_bins;
+
+    struct node {
+        int axis;
+        double split;
+        int child;     // Hijo izquierdo; el derecho es child + 1.
+        int leaf;      // Indice de hoja, o -1 en nodos interiores.
+    };
+
+    struct leaf_stats {
+        std::atomic<std::uint32_t> count{ 0 };
+        std::atomic<double> position_sum[3];
+        std::atomic<double> position_sq_sum[3];
+    };
+
+    int max_leaves;
+    int split_threshold;
+    int leaf_total = 0;
+    bool trained = false;
+    std::vector<node> nodes;
+    std::unique_ptr<std::atomic<double>[]> bins;  // Histogramas de entrenamiento.
+    std::unique_ptr<leaf_stats[]> stats;
+    std::vector<double> cdf;                      // Distribuciones congeladas (acumuladas).
+    std::vector<double> cdf_samples;              // Muestras con que se construyo cada una.
+
+    int find_leaf(const point3& p) const {
+        int n = 0;
+        while (nodes[n].leaf < 0)
+            n = nodes[n].child + (p[nodes[n].axis] < nodes[n].split ? 0 : 1);
+        return nodes[n].leaf;
+    }
+
+    static int bin_of(const vec3& dir) {
+        double u = 0.5 * (dir.z() + 1);
+        double v = (std::atan2(dir.y(), dir.x()) + pi) / (2 * pi);
+        int iu = std::min(cos_bins - 1, std::max(0, int(u * cos_bins)));
+        int iv = std::min(phi_bins - 1, std::max(0, int(v * phi_bins)));
+        return iu * phi_bins + iv;
+    }
+
+    static vec3 direction_of(double u, double v) {
+        double z = 2 * u - 1;
+        double r = std::sqrt(std::fmax(0.0, 1 - z * z));
+        double phi = 2 * pi * v - pi;
+        return vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+
+    static double bin_probability(const double* leaf_cdf, int bin) {
+        return leaf_cdf[bin] - (bin > 0 ? leaf_cdf[bin - 1] : 0.0);
+    }
+
+    void build_cdf(int leaf) {
+        std::atomic<double>* histogram = &bins[std::size_t(leaf) * bin_total];
+        double* leaf_cdf = &cdf[std::size_t(leaf) * bin_total];
+
+        double total = 0;
+        for (int b = 0; b < bin_total; b++)
+            total += histogram[b].load(std::memory_order_relaxed);
+        double count = stats[leaf].count.load(std::memory_order_relaxed);
+        if (!(total > 0) || count < cdf_samples[leaf])
+            return;  // Sin datos suficientes se conserva la distribucion anterior.
+        cdf_samples[leaf] = count;
+
+        // Una fraccion uniforme evita densidades nulas en direcciones aun no vistas.
+        const double uniform = 0.1;
+        double running = 0;
+        for (int b = 0; b < bin_total; b++) {
+            running += (1 - uniform) * histogram[b].load(std::memory_order_relaxed) / total
+                + uniform / bin_total;
+            leaf_cdf[b] = running;
+        }
+        leaf_cdf[bin_total - 1] = 1.0;
+    }
+
+    void reset_training() {
+        for (std::size_t i = 0; i < std::size_t(max_leaves) * bin_total; i++)
+            bins[i].store(0.0, std::memory_order_relaxed);
+        for (int leaf = 0; leaf < max_leaves; leaf++) {
+            stats[leaf].count.store(0, std::memory_order_relaxed);
+            for (int a = 0; a < 3; a++) {
+                stats[leaf].position_sum[a].store(0.0, std::memory_order_relaxed);
+                stats[leaf].position_sq_sum[a].store(0.0, std::memory_order_relaxed);
+            }
+        }
+        if (!trained) {
+            // Distribucion uniforme inicial.
+            for (int leaf = 0; leaf < max_leaves; leaf++)
+                for (int b = 0; b < bin_total; b++)
+                    cdf[std::size_t(leaf) * bin_total + b] = double(b + 1) / bin_total;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PLANE_H
+#define PLANE_H
+
+#include "hittable.h"
+#include "rtweekend.h"
+#include "material.h"
+#include <cmath>
+
+// Plano infinito: los puntos p con dot(normal, p) = d.
+class plane : public hittable {
+public:
+    plane(const point3& point, const vec3& normal, shared_ptr<material> m)
+        : normal(unit_vector(normal)), mat(m) {
+        d = dot(this->normal, point);
+    }
+
+    bool intersect(const ray& r, interval ray_t, hit_candidate& candidate) const override {
+        auto denom = dot(normal, r.direction());
+        if (std::fabs(denom) < 1e-12)
+            return false;  // Rayo paralelo al plano.
+
+        auto t = (d - dot(normal, r.origin())) / denom;
+        if (!ray_t.surrounds(t))
+            return false;
+
+        candidate.t = t;
+        candidate.object = this;
+        return true;
+    }
+
+    void complete_hit(const ray& r, double t, hit_record& rec) const override {
+        rec.t = t;
+        rec.p = r.at(t);
+        rec.set_face_normal(r, normal);
+        rec.mat = mat;
+    }
+
+    void collect_materials(std::vector<const material*>& out) const override { out.push_back(mat.get()); }
+
+    // No tiene limites: los aceleradores lo prueban aparte en vez de meterlo en la jerarquia.
+    aabb bounding_box() const override { return aabb::universe; }
+
+private:
+    vec3 normal;
+    double d;
+    shared_ptr<material> mat;
+};
+
+#endif
@@ -4,18 +4,25 @@
 #include "hittable_list.h"
 #include "material.h"
 #include "sphere.h"
+#include "plane.h"
 #include "metal.h"
 #include "box.h"
+#include "bvh.h"
+#include "render_server.h"
 
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <vector>
 using std::make_shared;
 
-int main() {
-    hittable_list world;
+shared_ptr<hittable_list> random_scene() {
+    auto scene = make_shared<hittable_list>();
+    hittable_list& world = *scene;
 
     auto ground_material = make_shared<lambertian>(color(0.5, 0.5, 0.5));
-    world.add(make_shared<sphere>(point3(0, -1000, 0), 1000, ground_material));
+    // Suelo analitico en y = 0 (antes una esfera de radio 1000).
+    world.add(make_shared<plane>(point3(0, 0, 0), vec3(0, 1, 0), ground_material));
 
     for (int a = -11; a < 11; a++) {
         for (int b = -11; b < 11; b++) {
@@ -81,6 +88,10 @@ int main() {
     auto material3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
     world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
 
+    return scene;
+}
+
+camera default_camera() {
     // Configuracin de la cmara.
     camera cam;
     cam.aspect_ratio = 16.0 / 9.0;
@@ -96,7 +107,67 @@ int main() {
     cam.defocus_angle = 0.6;
     cam.focus_dist = 10.0;
 
-    cam.render_to_file(world, "imagen.ppm");
+    return cam;
+}
+
+int main(int argc, char* argv[]) {
+    // El BVH se guarda en el directorio actual y se reutiliza en los siguientes arranques.
+    auto world = make_shared<bvh_accel>(*random_scene(), ".");
+    std::clog << "BVH: " << world->node_count() << " nodos, "
+              << world->unbounded_count() << " objetos fuera del arbol"
+              << (world->loaded_from_cache() ? " (cache)" : "") << "\n";
+    camera cam = default_camera();
+
+    // Opciones, en cualquier orden:
+    //   --server [hilos_de_trabajo] [hilos_por_trabajo]: la escena queda cargada y los
+    //       trabajos llegan por stdin.
+    //   --radiance-cache: los rebotes difusos secundarios usan la cache de radiancia.
+    //   --path-guiding: los rebotes difusos aprenden y siguen la luz incidente.
+    //   --stream: render por bandas en paralelo con escritura en orden; la memoria
+    //       depende del alto de banda, no del tamano de la imagen.
+    //   --band-height N, --threads N, --max-pending N: filas por banda, hilos de
+    //       render (0 = todos) y bandas terminadas en espera de escritura.
+    bool server_mode = false;
+    std::vector<int> thread_counts;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--server") == 0) {
+            server_mode = true;
+        }
+        else if (std::strcmp(argv[i], "--radiance-cache") == 0) {
+            cam.radiance_caching = true;
+        }
+        else if (std::strcmp(argv[i], "--path-guiding") == 0) {
+            cam.path_guiding = true;
+        }
+        else if (std::strcmp(argv[i], "--stream") == 0) {
+            cam.stream_output = true;
+        }
+        else if (std::strcmp(argv[i], "--band-height") == 0 && i + 1 < argc) {
+            cam.band_height = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            cam.render_threads = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--max-pending") == 0 && i + 1 < argc) {
+            cam.max_pending_bands = std::atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && server_mode) {
+            thread_counts.push_back(std::atoi(argv[i]));
+        }
+        else {
+            std::cerr << "Error: opcion desconocida " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    if (server_mode) {
+        int job_threads = thread_counts.size() > 0 ? thread_counts[0] : 1;
+        int threads_per_job = thread_counts.size() > 1 ? thread_counts[1] : 0;
+        render_server server(job_threads, threads_per_job);
+        server.add_scene("cubos", world, cam);
+        server.serve(std::cin, std::cout);
+        return 0;
+    }
 
-    return 0;
+    return cam.render_to_file(*world, "imagen.ppm") ? 0 : 1;
 }
@@ -0,0 +1,405 @@
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include "rtweekend.h"
+#include "camera.h"
+#include "hittable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Trabajo de render: escena ya cargada, camara y destino del resultado.
+struct render_job {
+    std::string scene;
+    camera cam;
+    int priority = 0;              // Mayor prioridad se atiende antes.
+    std::string output_path;       // Vacio = el resultado queda en memoria.
+};
+
+struct render_result {
+    int id = 0;
+    bool ok = false;
+    bool cancelled = false;
+    std::string error;
+    std::string output_path;
+    std::string image;             // Imagen PPM cuando no hay output_path.
+};
+
+// Servidor de render persistente. Las escenas se cargan una vez y se mantienen en
+// memoria; los trabajos se atienden por prioridad en varios hilos y se pueden cancelar.
+class render_server {
+public:
+    using result_callback = std::function<void(const render_result&)>;
+
+    explicit render_server(int job_threads = 1, int threads_per_job = 0)
+        : threads_per_job(threads_per_job) {
+        for (int t = 0; t < std::max(1, job_threads); t++)
+            workers.emplace_back([this] { work_loop(); });
+    }
+
+    ~render_server() {
+        stop();
+    }
+
+    render_server(const render_server&) = delete;
+    render_server& operator=(const render_server&) = delete;
+
+    // Registra una escena con la camara que usaran sus trabajos por defecto.
+    void add_scene(const std::string& name, shared_ptr<hittable> world, const camera& defaults) {
+        std::lock_guard<std::mutex> lock(mutex);
+        scenes[name] = scene_entry{ world, defaults };
+    }
+
+    bool find_scene(const std::string& name, camera& defaults) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = scenes.find(name);
+        if (it == scenes.end())
+            return false;
+        defaults = it->second.defaults;
+        return true;
+    }
+
+    std::vector<std::string> scene_names() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> names;
+        for (const auto& s : scenes)
+            names.push_back(s.first);
+        return names;
+    }
+
+    // Se invoca desde el hilo que termina cada trabajo.
+    void on_result(result_callback callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        notify = callback;
+    }
+
+    // Con detached = true nadie llamara a wait(): el resultado solo llega por on_result().
+    int submit(const render_job& job, bool detached = false) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto state = make_shared<job_state>();
+        state->id = next_id++;
+        state->order = state->id;
+        state->job = job;
+        state->detached = detached;
+        jobs[state->id] = state;
+        queue.push_back(state);
+        std::push_heap(queue.begin(), queue.end(), job_order());
+        work_ready.notify_one();
+        return state->id;
+    }
+
+    // Cancela un trabajo en cola o en curso. Devuelve false si no existe o ya termino.
+    bool cancel(int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = jobs.find(id);
+        if (it == jobs.end() || it->second->finished)
+            return false;
+        it->second->cancel = true;
+        return true;
+    }
+
+    // Espera a que termine el trabajo y entrega su resultado (una sola vez).
+    render_result wait(int id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = jobs.find(id);
+        if (it == jobs.end()) {
+            render_result missing;
+            missing.id = id;
+            missing.error = "trabajo desconocido";
+            return missing;
+        }
+        auto state = it->second;
+        job_done.wait(lock, [&] { return state->finished; });
+        jobs.erase(id);
+        return state->result;
+    }
+
+    // Termina los trabajos pendientes y detiene los hilos.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+                return;
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (auto& w : workers)
+            w.join();
+    }
+
+    // Protocolo de texto, una orden por linea:
+    //   render scene=<nombre> [width= spp= depth= priority= out= lookfrom=x,y,z
+    //          lookat=x,y,z vup=x,y,z vfov= aspect= defocus= focus=]
+    //   cancel <id>
+    //   scenes
+    //   quit
+    // Con out=- (o sin out) la imagen se devuelve por `out` tras "done <id> bytes=<n>".
+    void serve(std::istream& in, std::ostream& out) {
+        std::mutex out_mutex;
+        on_result([&](const render_result& r) {
+            std::lock_guard<std::mutex> lock(out_mutex);
+            if (r.cancelled)
+                out << "cancelled " << r.id << "\n";
+            else if (!r.ok)
+                out << "error " << r.id << " " << r.error << "\n";
+            else if (!r.output_path.empty())
+                out << "done " << r.id << " " << r.output_path << "\n";
+            else
+                out << "done " << r.id << " bytes=" << r.image.size() << "\n" << r.image;
+            out << std::flush;
+        });
+
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream words(line);
+            std::string command;
+            if (!(words >> command))
+                continue;
+
+            // Se mantiene el candado hasta responder para que "queued" preceda a "done".
+            std::lock_guard<std::mutex> lock(out_mutex);
+            std::string reply;
+            if (command == "quit") {
+                break;
+            }
+            else if (command == "scenes") {
+                for (const auto& name : scene_names())
+                    reply += name + " ";
+            }
+            else if (command == "cancel") {
+                int id = 0;
+                words >> id;
+                reply = (cancel(id) ? "cancelling " : "unknown ") + std::to_string(id);
+            }
+            else if (command == "render") {
+                render_job job;
+                std::string problem;
+                if (parse_job(words, job, problem)) {
+                    // En modo servidor el resultado se entrega siempre por callback.
+                    int id = submit(job, true);
+                    reply = "queued " + std::to_string(id);
+                }
+                else {
+                    reply = "error " + problem;
+                }
+            }
+            else {
+                reply = "error orden desconocida: " + command;
+            }
+
+            out << reply << "\n" << std::flush;
+        }
+
+        stop();
+        on_result(nullptr);
+    }
+
+private:
+    struct scene_entry {
+        shared_ptr<hittable> world;
+        camera defaults;
+    };
+
+    struct job_state {
+        int id = 0;
+        int order = 0;
+        render_job job;
+        std::atomic<bool> cancel{ false };
+        bool finished = false;
+        bool detached = false;
+        render_result result;
+    };
+
+    struct job_order {
+        bool operator()(const shared_ptr<job_state>& a, const shared_ptr<job_state>& b) const {
+            if (a->job.priority != b->job.priority)
+                return a->job.priority < b->job.priority;
+            return a->order > b->order;
+        }
+    };
+
+    int threads_per_job;
+    int next_id = 1;
+    bool stopping = false;
+    std::map<std::string, scene_entry> scenes;
+    std::map<int, shared_ptr<job_state>> jobs;
+    std::vector<shared_ptr<job_state>> queue;
+    result_callback notify;
+    mutable std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable job_done;
+    std::vector<std::thread> workers;
+
+    void work_loop() {
+        while (true) {
+            shared_ptr<job_state> state;
+            shared_ptr<hittable> world;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_ready.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                std::pop_heap(queue.begin(), queue.end(), job_order());
+                state = queue.back();
+                queue.pop_back();
+                auto it = scenes.find(state->job.scene);
+                if (it != scenes.end())
+                    world = it->second.world;
+            }
+
+            render_result result = run(*state, world);
+
+            result_callback callback;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                state->result = result;
+                state->finished = true;
+                if (state->detached)
+                    jobs.erase(state->id);
+                callback = notify;
+            }
+            job_done.notify_all();
+            if (callback)
+                callback(result);
+        }
+    }
+
+    render_result run(job_state& state, const shared_ptr<hittable>& world) const {
+        render_result result;
+        result.id = state.id;
+        result.output_path = state.job.output_path;
+
+        if (!world) {
+            result.error = "escena desconocida: " + state.job.scene;
+            return result;
+        }
+        if (state.cancel) {
+            result.cancelled = true;
+            return result;
+        }
+
+        camera cam = state.job.cam;
+        cam.stream_output = true;
+        cam.render_threads = threads_per_job;
+        cam.cancel_flag = &state.cancel;
+        cam.log_progress = false;
+
+        if (result.output_path.empty()) {
+            std::ostringstream image;
+            cam.render(*world, image);
+            result.image = image.str();
+        }
+        else {
+            std::ofstream file(result.output_path, std::ios::binary);
+            if (!file.is_open()) {
+                result.error = "no se pudo abrir " + result.output_path;
+                return result;
+            }
+            bool written = cam.render(*world, file);
+            file.close();
+            if (state.cancel) {
+                std::remove(result.output_path.c_str());
+            }
+            else if (!written || !file) {
+                result.error = "no se pudo escribir " + result.output_path;
+                return result;
+            }
+        }
+
+        result.cancelled = state.cancel;
+        result.ok = !result.cancelled;
+        if (result.cancelled)
+            result.image.clear();
+        return result;
+    }
+
+    static bool parse_vec3(const std::string& text, vec3& v) {
+        double x, y, z;
+        char c1, c2;
+        std::istringstream in(text);
+        if (!(in >> x >> c1 >> y >> c2 >> z) || c1 != ',' || c2 != ',')
+            return false;
+        v = vec3(x, y, z);
+        return true;
+    }
+
+    bool parse_job(std::istream& words, render_job& job, std::string& problem) const {
+        std::map<std::string, std::string> args;
+        std::string word;
+        while (words >> word) {
+            auto eq = word.find('=');
+            if (eq == std::string::npos) {
+                problem = "argumento sin valor: " + word;
+                return false;
+            }
+            args[word.substr(0, eq)] = word.substr(eq + 1);
+        }
+
+        job.scene = args["scene"];
+        if (!find_scene(job.scene, job.cam)) {
+            problem = "escena desconocida: " + job.scene;
+            return false;
+        }
+
+        try {
+            for (const auto& a : args) {
+                const std::string& key = a.first;
+                const std::string& value = a.second;
+                bool ok = true;
+                if (key == "scene") continue;
+                else if (key == "width") job.cam.image_width = std::stoi(value);
+                else if (key == "spp") job.cam.samples_per_pixel = std::stoi(value);
+                else if (key == "depth") job.cam.max_depth = std::stoi(value);
+                else if (key == "priority") job.priority = std::stoi(value);
+                else if (key == "vfov") job.cam.vfov = std::stod(value);
+                else if (key == "aspect") job.cam.aspect_ratio = std::stod(value);
+                else if (key == "defocus") job.cam.defocus_angle = std::stod(value);
+                else if (key == "focus") job.cam.focus_dist = std::stod(value);
+                else if (key == "out") job.output_path = value == "-" ? "" : value;
+                else if (key == "lookfrom") ok = parse_vec3(value, job.cam.lookfrom);
+                else if (key == "lookat") ok = parse_vec3(value, job.cam.lookat);
+                else if (key == "vup") ok = parse_vec3(value, job.cam.vup);
+                else {
+                    problem = "argumento desconocido: " + key;
+                    return false;
+                }
+                if (!ok) {
+                    problem = "valor invalido para " + key + ": " + value;
+                    return false;
+                }
+            }
+        }
+        catch (const std::exception&) {
+            problem = "valor numerico invalido";
+            return false;
+        }
+
+        if (job.cam.image_width < 1 || job.cam.samples_per_pixel < 1 || job.cam.max_depth < 1) {
+            problem = "width, spp y depth deben ser positivos";
+            return false;
+        }
+        // Escritas asi para rechazar tambien NaN.
+        if (!(job.cam.aspect_ratio > 0) || !(job.cam.focus_dist > 0)) {
+            problem = "aspect y focus deben ser positivos";
+            return false;
+        }
+        if (!(job.cam.vfov > 0 && job.cam.vfov < 180)) {
+            problem = "vfov debe estar entre 0 y 180";
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef RTWEEKEND_H
 #define RTWEEKEND_H
 
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <random>
 #include "interval.h"
 
 
@@ -26,9 +28,19 @@ inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
+inline unsigned int next_thread_seed() {
+    // Cada hilo recibe su propia semilla; el primero (main) siempre la misma,
+    // de modo que la escena generada es reproducible.
+    static std::atomic<unsigned int> counter(0);
+    return 5489u + 7919u * counter.fetch_add(1);
+}
+
 inline double random_double() {
     // Returns a random real in [0,1).
-    return std::rand() / (RAND_MAX + 1.0);
+    // Generador por hilo: std::rand comparte estado y no escala con varios hilos.
+    static thread_local std::mt19937 generator(next_thread_seed());
+    static thread_local std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(generator);
 }
 
 inline double random_double(double min, double max) {
@@ -36,6 +48,14 @@ inline double random_double(double min, double max) {
     return min + (max - min) * random_double();
 }
 
+inline void atomic_add(std::atomic<double>& target, double value) {
+    // Suma atomica sin candados para acumuladores compartidos entre hilos de render
+    // (std::atomic<double>::fetch_add no existe antes de C++20).
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
 // Common Headers
 
 #include "color.h"
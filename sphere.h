@@ -11,9 +11,11 @@ public:
     // Se inicializa la esfera con centro, radio y material.
     sphere(const point3& center, double radius, shared_ptr<material> m)
         : center(center), radius(std::fmax(0, radius)), mat(m) {
+        auto rvec = vec3(this->radius, this->radius, this->radius);
+        bbox = aabb(center - rvec, center + rvec);
     }
 
-    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+    bool intersect(const ray& r, interval ray_t, hit_candidate& candidate) const override {
         vec3 oc = r.origin() - center;
         auto a = r.direction().length_squared();
         auto half_b = dot(oc, r.direction());
@@ -32,19 +34,28 @@ public:
                 return false;
         }
 
-        rec.t = root;
-        rec.p = r.at(rec.t);
+        candidate.t = root;
+        candidate.object = this;
+        return true;
+    }
+
+    void complete_hit(const ray& r, double t, hit_record& rec) const override {
+        rec.t = t;
+        rec.p = r.at(t);
         vec3 outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r, outward_normal);
         rec.mat = mat;
-
-        return true;
     }
 
+    void collect_materials(std::vector<const material*>& out) const override { out.push_back(mat.get()); }
+
+    aabb bounding_box() const override { return bbox; }
+
 private:
     point3 center;
     double radius;
     shared_ptr<material> mat;
+    aabb bbox;
 };
 
 #endif
@@ -6,6 +6,12 @@
 #include <cstdlib>
 #include <iostream>
 
+// Con RT_VEC3_SIMD definido en la compilacion se usa el vec3 vectorial de vec3_simd.h
+// (AVX2, cuatro carriles). Ambas versiones ofrecen la misma interfaz.
+#if defined(RT_VEC3_SIMD)
+#include "vec3_simd.h"
+#else
+
 class vec3 {
 public:
     double e[3];
@@ -62,13 +68,7 @@ public:
     }
 };
 
-using point3 = vec3;  
-
 // Operadores y funciones auxiliares para vec3:
-inline std::ostream& operator<<(std::ostream& out, const vec3& v) {
-    return out << v.e[0] << " " << v.e[1] << " " << v.e[2];
-}
-
 inline vec3 operator+(const vec3& u, const vec3& v) {
     return vec3(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
 }
@@ -107,6 +107,27 @@ inline vec3 unit_vector(const vec3& v) {
     return v / v.length();
 }
 
+inline vec3 component_min(const vec3& u, const vec3& v) {
+    return vec3(std::fmin(u.e[0], v.e[0]), std::fmin(u.e[1], v.e[1]), std::fmin(u.e[2], v.e[2]));
+}
+
+inline vec3 component_max(const vec3& u, const vec3& v) {
+    return vec3(std::fmax(u.e[0], v.e[0]), std::fmax(u.e[1], v.e[1]), std::fmax(u.e[2], v.e[2]));
+}
+
+// Mascara de componentes con u < v: bit 0 = x, bit 1 = y, bit 2 = z.
+inline int less_mask(const vec3& u, const vec3& v) {
+    return (u.e[0] < v.e[0] ? 1 : 0) | (u.e[1] < v.e[1] ? 2 : 0) | (u.e[2] < v.e[2] ? 4 : 0);
+}
+
+#endif // RT_VEC3_SIMD
+
+using point3 = vec3;
+
+inline std::ostream& operator<<(std::ostream& out, const vec3& v) {
+    return out << v.e[0] << " " << v.e[1] << " " << v.e[2];
+}
+
 inline vec3 random_in_unit_disk() {
     while (true) {
         auto p = vec3(random_double(-1,1), random_double(-1,1), 0);
@@ -0,0 +1,174 @@
+#ifndef VEC3_SIMD_H
+#define VEC3_SIMD_H
+
+// Version vectorial de vec3: los tres componentes y un cuarto carril a cero en un
+// registro AVX de cuatro doubles. Se activa con RT_VEC3_SIMD (ver vec3.h) y necesita
+// AVX2 (/arch:AVX2 en MSVC, -mavx2 en GCC/Clang).
+//
+// Tolerancia respecto a la version escalar: suma, resta, productos y cross dan el
+// mismo resultado, tambien con infinitos y NaN en los tres componentes; dot y
+// length_squared suman en otro orden (solo cambia el redondeo) y unit_vector usa
+// rsqrt aproximado con dos pasos de Newton-Raphson, con un error relativo menor que
+// 1e-12. component_min/max siguen la semantica de minpd/maxpd con NaN (devuelven el
+// segundo operando), no la de std::fmin/fmax.
+
+#if !defined(__AVX2__)
+#error "RT_VEC3_SIMD requiere compilar con AVX2"
+#endif
+
+#include <immintrin.h>
+#include <cmath>
+
+// Alinear a 32 bytes solo es seguro si new respeta la alineacion (C++17); antes de
+// eso un vec3 dentro de un objeto creado con make_shared podria quedar desalineado.
+#if defined(__cpp_aligned_new)
+#define VEC3_SIMD_ALIGN alignas(32)
+#else
+#define VEC3_SIMD_ALIGN
+#endif
+
+// v * t con el escalar repetido en los cuatro carriles. El cuarto carril se vuelve a
+// poner a 0: con t infinito o NaN, 0 * t daria NaN y contaminaria dot y length.
+inline __m256d scale_xyz(__m256d v, double t) {
+    return _mm256_blend_pd(_mm256_mul_pd(v, _mm256_set1_pd(t)), _mm256_setzero_pd(), 0x8);
+}
+
+class VEC3_SIMD_ALIGN vec3 {
+public:
+    // El cuarto carril siempre vale 0. Las cargas no exigen alineacion, asi que el
+    // mismo codigo vale con o sin VEC3_SIMD_ALIGN.
+    double e[4];
+
+    vec3() { store(_mm256_setzero_pd()); }
+    vec3(double e0, double e1, double e2) { store(_mm256_set_pd(0.0, e2, e1, e0)); }
+    explicit vec3(__m256d v) { store(v); }
+
+    __m256d simd() const { return _mm256_loadu_pd(e); }
+
+    double x() const { return e[0]; }
+    double y() const { return e[1]; }
+    double z() const { return e[2]; }
+
+    vec3 operator-() const { return vec3(_mm256_xor_pd(simd(), _mm256_set1_pd(-0.0))); }
+    double operator[](int i) const { return e[i]; }
+    double& operator[](int i) { return e[i]; }
+
+    vec3& operator+=(const vec3& v) {
+        store(_mm256_add_pd(simd(), v.simd()));
+        return *this;
+    }
+
+    vec3& operator*=(double t) {
+        store(scale_xyz(simd(), t));
+        return *this;
+    }
+
+    vec3& operator/=(double t) {
+        return *this *= 1 / t;
+    }
+
+    double length() const {
+        return std::sqrt(length_squared());
+    }
+
+    double length_squared() const;
+
+    static vec3 random() {
+        return vec3(random_double(), random_double(), random_double());
+    }
+
+    static vec3 random(double min, double max) {
+        return vec3(random_double(min, max), random_double(min, max), random_double(min, max));
+    }
+
+    bool near_zero() const {
+        __m256d magnitude = _mm256_andnot_pd(_mm256_set1_pd(-0.0), simd());
+        __m256d small = _mm256_cmp_pd(magnitude, _mm256_set1_pd(1e-8), _CMP_LT_OQ);
+        return (_mm256_movemask_pd(small) & 0x7) == 0x7;
+    }
+
+private:
+    void store(__m256d v) { _mm256_storeu_pd(e, v); }
+};
+
+// Suma de los cuatro carriles (el cuarto es 0).
+inline double horizontal_sum(__m256d v) {
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    __m128d pair = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+inline double vec3::length_squared() const {
+    __m256d v = simd();
+    return horizontal_sum(_mm256_mul_pd(v, v));
+}
+
+inline vec3 operator+(const vec3& u, const vec3& v) {
+    return vec3(_mm256_add_pd(u.simd(), v.simd()));
+}
+
+inline vec3 operator-(const vec3& u, const vec3& v) {
+    return vec3(_mm256_sub_pd(u.simd(), v.simd()));
+}
+
+inline vec3 operator*(const vec3& u, const vec3& v) {
+    return vec3(_mm256_mul_pd(u.simd(), v.simd()));
+}
+
+inline vec3 operator*(double t, const vec3& v) {
+    return vec3(scale_xyz(v.simd(), t));
+}
+
+inline vec3 operator*(const vec3& v, double t) {
+    return t * v;
+}
+
+inline vec3 operator/(const vec3& v, double t) {
+    return (1 / t) * v;
+}
+
+inline double dot(const vec3& u, const vec3& v) {
+    return horizontal_sum(_mm256_mul_pd(u.simd(), v.simd()));
+}
+
+inline vec3 cross(const vec3& u, const vec3& v) {
+    // u.yzx * v.zxy - u.zxy * v.yzx; el cuarto carril sigue en 0.
+    __m256d a = u.simd(), b = v.simd();
+    __m256d a_yzx = _mm256_permute4x64_pd(a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m256d b_zxy = _mm256_permute4x64_pd(b, _MM_SHUFFLE(3, 1, 0, 2));
+    __m256d a_zxy = _mm256_permute4x64_pd(a, _MM_SHUFFLE(3, 1, 0, 2));
+    __m256d b_yzx = _mm256_permute4x64_pd(b, _MM_SHUFFLE(3, 0, 2, 1));
+    return vec3(_mm256_sub_pd(_mm256_mul_pd(a_yzx, b_zxy), _mm256_mul_pd(a_zxy, b_yzx)));
+}
+
+// 1/sqrt(x): estimacion rsqrt en float refinada con dos pasos de Newton-Raphson.
+// Fuera del rango normal de float se usa la division exacta.
+inline double fast_rsqrt(double x) {
+    if (!(x > 1e-30 && x < 1e30))
+        return 1.0 / std::sqrt(x);
+    double y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(float(x))));
+    double half_x = 0.5 * x;
+    y = y * (1.5 - half_x * y * y);
+    y = y * (1.5 - half_x * y * y);
+    return y;
+}
+
+inline vec3 unit_vector(const vec3& v) {
+    return vec3(scale_xyz(v.simd(), fast_rsqrt(v.length_squared())));
+}
+
+inline vec3 component_min(const vec3& u, const vec3& v) {
+    return vec3(_mm256_min_pd(u.simd(), v.simd()));
+}
+
+inline vec3 component_max(const vec3& u, const vec3& v) {
+    return vec3(_mm256_max_pd(u.simd(), v.simd()));
+}
+
+// Mascara de componentes con u < v: bit 0 = x, bit 1 = y, bit 2 = z.
+inline int less_mask(const vec3& u, const vec3& v) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(u.simd(), v.simd(), _CMP_LT_OQ)) & 0x7;
+}
+
+#endif